@@ -0,0 +1,145 @@
+/******************************************
+ * PCA9685 RGB frame buffer
+ *
+ * Holds the PWM value of every channel on a set of chained PCA9685 chips
+ * and only sends the channels that changed since the last flush. Each
+ * chip's changed span goes out as auto-increment register bursts instead
+ * of one I2C transaction per channel.
+ *
+ * The bus is a template parameter so the same code runs against Wire on
+ * the clock and against a counting bus in bench/led_frame_bench.cpp.
+ ******************************************/
+
+#ifndef PCA9685_FRAME_H
+#define PCA9685_FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// PCA9685 registers
+#define PCA_MODE1 0x00
+#define PCA_LED0_ON_L 0x06
+#define PCA_PRESCALE 0xFE
+
+// MODE1 bits
+#define PCA_MODE1_AI 0x20    // register auto-increment, needed for burst writes
+#define PCA_MODE1_SLEEP 0x10 // oscillator off, required to change PRESCALE
+
+#define PCA_Channels 16
+#define PCA_Oscillator 25000000.0
+#define PCA_Burst_Channels 7 // 1 register byte + 7 * 4 bytes fits the 32 byte AVR Wire buffer
+
+// Abstraction of an RGB LED as (chip, red, green, blue) outputs
+struct RGB_LED {
+  uint8_t chip;
+  uint8_t r;
+  uint8_t g;
+  uint8_t b;
+};
+
+// Compile-time check that every LED in a map names a configured chip and a real output
+template <size_t N>
+constexpr bool validLEDMap(const RGB_LED (&leds)[N], size_t numChips, size_t i = 0) {
+  return i == N ||
+         (leds[i].chip < numChips &&
+          leds[i].r < PCA_Channels && leds[i].g < PCA_Channels && leds[i].b < PCA_Channels &&
+          validLEDMap(leds, numChips, i + 1));
+}
+
+template <typename Bus, uint8_t NumChips>
+class PCA9685_Frame {
+public:
+  PCA9685_Frame(Bus &busRef, const uint8_t *chipAddresses)
+    : bus(busRef), addresses(chipAddresses) {
+    for (uint8_t chip = 0; chip < NumChips; chip++) {
+      for (uint8_t ch = 0; ch < PCA_Channels; ch++)
+        frame[chip][ch] = 0;
+      dirty[chip] = 0;
+      present[chip] = false;
+    }
+  }
+
+  // Sets the PWM frequency with auto-increment on and queues an all-off frame,
+  // returns false if the chip does not answer on the bus
+  bool begin(uint8_t chip, float freq) {
+    uint8_t prescale = (uint8_t)(PCA_Oscillator / (4096.0 * freq) + 0.5) - 1;
+
+    present[chip] = writeRegister(chip, PCA_MODE1, PCA_MODE1_SLEEP | PCA_MODE1_AI);
+    if (!present[chip])
+      return false;
+
+    writeRegister(chip, PCA_PRESCALE, prescale);
+    writeRegister(chip, PCA_MODE1, PCA_MODE1_AI); // wake with auto-increment kept on
+
+    dirty[chip] = 0xFFFF;
+    return true;
+  }
+
+  void setChannel(uint8_t chip, uint8_t channel, uint16_t value) {
+    if (chip >= NumChips || channel >= PCA_Channels)
+      return;
+    if (value > 4095)
+      value = 4095;
+    if (frame[chip][channel] == value)
+      return;
+
+    frame[chip][channel] = value;
+    dirty[chip] |= (1U << channel);
+  }
+
+  void setLED(const RGB_LED &led, uint16_t r, uint16_t g, uint16_t b) {
+    setChannel(led.chip, led.r, r);
+    setChannel(led.chip, led.g, g);
+    setChannel(led.chip, led.b, b);
+  }
+
+  // Sends the changed span of each chip, relies on MODE1.AI set in begin()
+  void flush() {
+    for (uint8_t chip = 0; chip < NumChips; chip++) {
+      uint16_t bits = dirty[chip];
+      if (bits == 0 || !present[chip])
+        continue;
+
+      uint8_t first = 0;
+      while (!(bits & (1U << first)))
+        first++;
+      uint8_t last = PCA_Channels - 1;
+      while (!(bits & (1U << last)))
+        last--;
+
+      for (uint8_t start = first; start <= last; start += PCA_Burst_Channels) {
+        uint8_t end = start + PCA_Burst_Channels - 1;
+        if (end > last)
+          end = last;
+
+        bus.beginTransmission(addresses[chip]);
+        bus.write(PCA_LED0_ON_L + 4 * start);
+        for (uint8_t ch = start; ch <= end; ch++) {
+          uint16_t value = frame[chip][ch];
+          bus.write(0);            // ON_L
+          bus.write(0);            // ON_H
+          bus.write(value & 0xFF); // OFF_L
+          bus.write(value >> 8);   // OFF_H
+        }
+        bus.endTransmission();
+      }
+      dirty[chip] = 0;
+    }
+  }
+
+private:
+  bool writeRegister(uint8_t chip, uint8_t reg, uint8_t value) {
+    bus.beginTransmission(addresses[chip]);
+    bus.write(reg);
+    bus.write(value);
+    return bus.endTransmission() == 0;
+  }
+
+  Bus &bus;
+  const uint8_t *addresses;
+  uint16_t frame[NumChips][PCA_Channels];
+  uint16_t dirty[NumChips]; // bit per channel changed since last flush
+  bool present[NumChips];
+};
+
+#endif
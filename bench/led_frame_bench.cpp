@@ -0,0 +1,88 @@
+/******************************************
+ * Host benchmark for PCA9685_Frame.h
+ *
+ * Counts the I2C transactions and bytes a frame costs for different LED
+ * counts, against the old one-setPWM-per-channel approach. Bus time is
+ * estimated at 100 kHz with 9 clocks per byte and 2 for start/stop.
+ *
+ * Build and run from the repo root:
+ *   g++ -O2 -I. bench/led_frame_bench.cpp -o bench/led_frame_bench && bench/led_frame_bench
+ ******************************************/
+
+#include <stdio.h>
+#include "PCA9685_Frame.h"
+
+// Stands in for Wire and counts what would go over the bus
+struct Counting_Bus {
+  unsigned long transactions = 0;
+  unsigned long bytes = 0; // including the address byte
+
+  void beginTransmission(uint8_t) { transactions++; bytes++; }
+  void write(int) { bytes++; }
+  uint8_t endTransmission() { return 0; }
+
+  void reset() { transactions = 0; bytes = 0; }
+  double busMicros() const { return (bytes * 9 + transactions * 2) * 10.0; }
+};
+
+const uint8_t addresses[] = {0x40, 0x41, 0x42, 0x43};
+#define LEDs_Per_Chip 5 // 15 of the 16 channels
+#define Animated_Frames 100
+
+template <uint8_t NumChips>
+void runCase(uint8_t numLEDs) {
+  Counting_Bus bus;
+  PCA9685_Frame<Counting_Bus, NumChips> leds(bus, addresses);
+
+  RGB_LED ledMap[20];
+  for (uint8_t i = 0; i < numLEDs; i++) {
+    uint8_t base = (i % LEDs_Per_Chip) * 3;
+    ledMap[i] = {(uint8_t)(i / LEDs_Per_Chip), base, (uint8_t)(base + 1), (uint8_t)(base + 2)};
+  }
+
+  for (uint8_t chip = 0; chip < NumChips; chip++)
+    leds.begin(chip, 1000);
+  leds.flush();
+
+  // Static preset: first frame changes every LED, the repeat changes nothing
+  bus.reset();
+  for (uint8_t i = 0; i < numLEDs; i++)
+    leds.setLED(ledMap[i], 1000, 0, 0);
+  leds.flush();
+  unsigned long firstTx = bus.transactions, firstBytes = bus.bytes;
+
+  bus.reset();
+  for (uint8_t i = 0; i < numLEDs; i++)
+    leds.setLED(ledMap[i], 1000, 0, 0);
+  leds.flush();
+  unsigned long repeatTx = bus.transactions;
+
+  // Animated preset: every channel changes every frame
+  bus.reset();
+  for (uint16_t f = 0; f < Animated_Frames; f++) {
+    for (uint8_t i = 0; i < numLEDs; i++)
+      leds.setLED(ledMap[i], f + i, f + i + 1, f + i + 2);
+    leds.flush();
+  }
+  double animTx = (double)bus.transactions / Animated_Frames;
+  double animBytes = (double)bus.bytes / Animated_Frames;
+  double animUs = bus.busMicros() / Animated_Frames;
+
+  // One setPWM per channel: address + register + 4 data bytes each
+  unsigned long legacyTx = numLEDs * 3;
+  double legacyUs = (legacyTx * 6 * 9 + legacyTx * 2) * 10.0;
+
+  printf("%4u %5u | %8lu %6lu %7lu | %8.1f %6.1f %8.0f | %8lu %8.0f\n",
+         numLEDs, NumChips, firstTx, firstBytes, repeatTx,
+         animTx, animBytes, animUs, legacyTx, legacyUs);
+}
+
+int main() {
+  printf("           | static frame            | animated frame           | per-channel setPWM\n");
+  printf("LEDs chips | first tx  bytes  repeat | tx/frame  bytes   bus us | tx/frame   bus us\n");
+  runCase<1>(4);
+  runCase<2>(8);
+  runCase<3>(12);
+  runCase<4>(20);
+  return 0;
+}
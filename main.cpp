@@ -10,10 +10,10 @@
 
 #include <Arduino.h>
 #include <Wire.h>
-#include <Adafruit_PWMServoDriver.h>
 #include <IRremote.hpp>
 #include "RTClib.h"
 #include <EEPROM.h>
+#include "PCA9685_Frame.h"
 
 // Shift register, IR input, and colon digit pins
 #define Shift_Data 4
@@ -53,13 +53,26 @@
 #define Preset_Fire 8
 #define Preset_Rainbow 9
 
+// Display modes
+#define Mode_Time 0
+#define Mode_Poison 1
+#define Mode_Date 2
+#define Mode_Setting 3
+#define Mode_Blank 4
+
+// Brightness shown as a 1-20 level in the setting view
+#define Brightness_Levels 20
+
+// BCD value outside 0-9 turns a tube off
+#define Digit_Blank 0xF
+
 // GAmma correction
 #define GAMMA 2.2
 
 int RGB_Brightness = 1000; // Default brightness
 int currentPreset = 0; // Current RGB preset
 uint8_t activeEffect = 0; // Current RGB preset being displayed
-bool longPoison = false;
+uint8_t lastLongPoisonDay = 0; // day of month the 3AM cycle last ran
 
 uint32_t code;
 
@@ -71,15 +84,27 @@ const int EEPROM_DaylightSavings_Address = 2;
 
 RTC_DS3231 rtc; // Real-time-clock instance
 
-Adafruit_PWMServoDriver pwm = Adafruit_PWMServoDriver(); // default I2C address 0x40 for PCA RGB driver
-
-// Abstraction of RGB LED channels
-uint8_t rgbChannels[4][3] = {
-  {0, 1, 2},   // LED 1
-  {3, 4, 5},   // LED 2
-  {6, 7, 8},   // LED 3
-  {9, 10, 11}  // LED 4
+// PCA9685 RGB drivers chained on the I2C bus, chip index in the LED map is the position in this table
+constexpr uint8_t pcaAddresses[] = {
+  0x40  // default I2C address
+};
+#define Num_PCA (sizeof(pcaAddresses) / sizeof(pcaAddresses[0]))
+
+// RGB LED channels, each LED is (chip, red, green, blue) outputs
+constexpr RGB_LED rgbChannels[] = {
+  {0, 0, 1, 2},   // LED 1
+  {0, 3, 4, 5},   // LED 2
+  {0, 6, 7, 8},   // LED 3
+  {0, 9, 10, 11}  // LED 4
 };
+#define Num_LEDs (sizeof(rgbChannels) / sizeof(rgbChannels[0]))
+static_assert(validLEDMap(rgbChannels, Num_PCA), "rgbChannels has an LED on a chip or output that does not exist");
+
+PCA9685_Frame<TwoWire, Num_PCA> leds(Wire, pcaAddresses); // RGB frame buffer, sent once per loop
+
+void setLED(uint8_t led, uint16_t r, uint16_t g, uint16_t b) {
+  leds.setLED(rgbChannels[led], r, g, b);
+}
 
 uint16_t gammaLUT[256];  
 
@@ -96,38 +121,100 @@ void rgbToPwm(uint8_t r, uint8_t g, uint8_t b, uint16_t &pr, uint16_t &pg, uint1
     pb = map(b, 0, 255, 0, 4095);
 }
 
-// Logic to display digits on nixie tubes using shift registers and BCD IC
-void displayDigit(uint8_t digits[4]) {
-  uint8_t data[2];
-
-  for (uint8_t i = 0; i < 2; i++) {
-    uint8_t digit1 = digits[i * 2];
-    uint8_t digit2 = digits[i * 2 + 1];
+// Packs 4 digits into the 16 bit word held by the shift registers (one BCD nibble per tube)
+uint16_t packFrame(const uint8_t digits[4]) {
+  uint16_t frame = 0;
 
-    if (digit1 > 9)
-      digit1 = 0xF;
-    if (digit2 > 9)
-      digit2 = 0xF;
+  for (uint8_t i = 0; i < 4; i++) {
+    uint8_t digit = digits[i];
+    if (digit > 9)
+      digit = Digit_Blank;
 
-    data[i] = (digit2 << 4) | (digit1 & 0x0F);
+    frame |= (uint16_t)digit << (i * 4);
   }
+  return frame;
+}
+
+// Single latch point for the nixie tubes, only shifts out when the frame changes
+uint16_t latchedFrame = 0;
+bool frameLatched = false;
+void latchFrame(uint16_t frame) {
+  if (frameLatched && frame == latchedFrame)
+    return;
 
   digitalWrite(Shift_Latch, LOW);
-  for (int i = 2 - 1; i >= 0; i--) {
-    shiftOut(Shift_Data, Shift_CLK, MSBFIRST, data[i]);
-  }
+  shiftOut(Shift_Data, Shift_CLK, MSBFIRST, frame >> 8);
+  shiftOut(Shift_Data, Shift_CLK, MSBFIRST, frame & 0xFF);
   digitalWrite(Shift_Latch, HIGH);
+
+  latchedFrame = frame;
+  frameLatched = true;
+}
+
+// Display state machine. Time and Poison are base modes driven by the clock,
+// Date and Setting are timed views that fall back to the base mode, and Blank
+// holds until toggled off. A new view needs a mode, an Enter function, a
+// Build_Frame case and, if it should turn the colon off, a Colon_On case.
+uint8_t displayMode = Mode_Time;
+uint8_t baseMode = Mode_Time;       // mode shown when no view is active
+unsigned long modeStart = 0;
+unsigned long modeDuration = 0;     // 0 for modes without a timeout
+
+// Switches to a view, a duration of 0 keeps it until another transition
+void Enter_Mode(uint8_t mode, unsigned long duration) {
+  if (displayMode == Mode_Blank)
+    return; // Blank only exits through Toggle_Blank
+
+  displayMode = mode;
+  modeStart = millis();
+  modeDuration = duration;
+}
+
+// Changes the base mode underneath any active view
+void Set_Base_Mode(uint8_t mode) {
+  if (displayMode == baseMode)
+    displayMode = mode;
+  baseMode = mode;
 }
 
 // Displays current month and day for 5 seconds
-unsigned long dateDisplayStart = 0;
 const unsigned long dateDisplayDuration = 5000;
-bool showingDate = false;
 uint8_t Date_Digits[4];
-void Display_Date() {
-  if (millis() - dateDisplayStart >= dateDisplayDuration)
-    showingDate = false;
-  displayDigit(Date_Digits);
+void Enter_Date() {
+  Date_Digits[0] = now.day() / 10;
+  Date_Digits[1] = now.day() % 10;
+  Date_Digits[2] = now.month() / 10;
+  Date_Digits[3] = now.month() % 10;
+  Enter_Mode(Mode_Date, dateDisplayDuration);
+}
+
+// Displays a 0-99 setting level on the right tubes for 2 seconds, left tubes off
+const unsigned long settingDisplayDuration = 2000;
+uint8_t Setting_Digits[4];
+void Enter_Setting(uint8_t level) {
+  Setting_Digits[0] = level >= 10 ? level / 10 % 10 : Digit_Blank;
+  Setting_Digits[1] = level % 10;
+  Setting_Digits[2] = Digit_Blank;
+  Setting_Digits[3] = Digit_Blank;
+  Enter_Mode(Mode_Setting, settingDisplayDuration);
+}
+
+// Turns the tubes and colon off, or back on to the base mode
+void Toggle_Blank() {
+  if (displayMode == Mode_Blank) {
+    displayMode = baseMode;
+  } else {
+    displayMode = Mode_Blank;
+    modeDuration = 0;
+  }
+}
+
+// Expires timed views back to the base mode
+void Update_Display_Mode() {
+  if (modeDuration != 0 && millis() - modeStart >= modeDuration) {
+    displayMode = baseMode;
+    modeDuration = 0;
+  }
 }
 
 // Adjustment for Daylight Savings 
@@ -153,7 +240,6 @@ void Daylight_Savings() {
 unsigned long lastPoisonCycle = 0;      
 unsigned long poisonInterval = 14400000; // 4 hours in ms
 unsigned long stepInterval = 200;    // ms between digit updates
-bool poisonPrevention = false;
 
 uint8_t currentDigit[4]; // current digits being displayed
 bool digitStopped[4]; // true when tube has stopped
@@ -165,49 +251,53 @@ uint8_t targetDigit[4]; // Target digits to stop at
 
 int fullSpinsBeforeStop = 2; // number of full rotations before stopping
 int spinCounter[4] = {0, 0, 0, 0};
-void Nixie_Poisoning_Prevention() {
-    unsigned long poisonNow = millis();
 
-    // Trigger poison prevention every 4 hours or at 3AM
-    if ((!poisonPrevention && poisonNow - lastPoisonCycle >= poisonInterval) || longPoison) {
-        
-        // For longer cycle at 3AM
-        if (longPoison) {
-          stepInterval = 1000;
-          fullSpinsBeforeStop = 1;
-        }
+// Starts a poison cycle that stops on the current time, long cycles spin slower for the 3AM run
+void Start_Poison_Cycle(bool longCycle) {
+    unsigned long poisonNow = millis();
 
-        // For shorter cycle every 4 hours
-        else {
-          stepInterval = 200;
-          fullSpinsBeforeStop = 2;
-        }
+    if (longCycle) {
+      stepInterval = 1000;
+      fullSpinsBeforeStop = 1;
+    }
+    else {
+      stepInterval = 200;
+      fullSpinsBeforeStop = 2;
+    }
 
-        poisonPrevention = true;
-        lastStepTime = poisonNow;
-        lastPoisonCycle = poisonNow;
+    lastStepTime = poisonNow;
+    lastPoisonCycle = poisonNow;
+
+    // Get current time to use as final target
+    DateTime nowTime = rtc.now();
+    int hour24 = nowTime.hour();
+    int hour12 = hour24 % 12;
+    if (hour12 == 0) hour12 = 12;
+
+    targetDigit[0] = nowTime.minute() / 10;
+    targetDigit[1] = nowTime.minute() % 10;
+    targetDigit[2] = hour12 / 10;
+    targetDigit[3] = hour12 % 10;
+
+    // Initialize current digits and stop flags
+    for (int i = 0; i < 4; i++) {
+        currentDigit[i] = 0;  // start spinning from 0
+        digitStopped[i] = false;
+        spinCounter[i] = 0;   // reset full spin counter
+    }
+    stopIndex = 0;
 
-        // Get current time to use as final target
-        DateTime nowTime = rtc.now();
-        int hour24 = nowTime.hour();
-        int hour12 = hour24 % 12;
-        if (hour12 == 0) hour12 = 12;
+    Set_Base_Mode(Mode_Poison);
+}
 
-        targetDigit[0] = nowTime.minute() / 10;
-        targetDigit[1] = nowTime.minute() % 10;
-        targetDigit[2] = hour12 / 10;
-        targetDigit[3] = hour12 % 10;
+void Nixie_Poisoning_Prevention() {
+    unsigned long poisonNow = millis();
 
-        // Initialize current digits and stop flags
-        for (int i = 0; i < 4; i++) {
-            currentDigit[i] = 0;  // start spinning from 0
-            digitStopped[i] = false;
-            spinCounter[i] = 0;   // reset full spin counter
-        }
-        stopIndex = 0;
-    }
+    // Short poison prevention cycle every 4 hours
+    if (baseMode != Mode_Poison && poisonNow - lastPoisonCycle >= poisonInterval)
+        Start_Poison_Cycle(false);
 
-    if (!poisonPrevention) return;
+    if (baseMode != Mode_Poison) return;
 
     // Update digits if step interval elapsed
     if (poisonNow - lastStepTime >= stepInterval) {
@@ -233,20 +323,52 @@ void Nixie_Poisoning_Prevention() {
             }
         }
 
-        // Display the current digits
-        displayDigit(currentDigit);
-
         // Finish cycle if all digits stopped
         bool allStopped = true;
         for (int i = 0; i < 4; i++) {
             if (!digitStopped[i]) allStopped = false;
         }
         if (allStopped) {
-            poisonPrevention = false; // done
+            Set_Base_Mode(Mode_Time); // done
         }
     }
 }
 
+// Builds the one frame word shown this loop for the current display mode
+uint16_t Build_Frame(const uint8_t timeDigits[4]) {
+  static const uint8_t blankDigits[4] = {Digit_Blank, Digit_Blank, Digit_Blank, Digit_Blank};
+
+  switch (displayMode) {
+    case Mode_Poison:
+      return packFrame(currentDigit); // slot-machine digits
+
+    case Mode_Date:
+      return packFrame(Date_Digits);
+
+    case Mode_Setting:
+      return packFrame(Setting_Digits);
+
+    case Mode_Blank:
+      return packFrame(blankDigits);
+
+    case Mode_Time:
+    default:
+      return packFrame(timeDigits);
+  }
+}
+
+// Colon fades in every mode except Blank and Setting, where a lit colon would make the tubes read as a time
+bool Colon_On() {
+  switch (displayMode) {
+    case Mode_Setting:
+    case Mode_Blank:
+      return false;
+
+    default:
+      return true;
+  }
+}
+
 void setup() {
   Serial.begin(9600);
   pinMode(Shift_Data, OUTPUT);
@@ -260,9 +382,15 @@ void setup() {
     while (1);
   }
 
-  // Begin PWM for PCA RGB chip
-  pwm.begin();
-  pwm.setPWMFreq(1000);
+  // Begin PWM for each PCA RGB chip and push a known all-off frame
+  Wire.begin();
+  for (uint8_t chip = 0; chip < Num_PCA; chip++) {
+    if (!leds.begin(chip, 1000)) {
+      Serial.print("Couldn't find PCA9685 at 0x");
+      Serial.println(pcaAddresses[chip], HEX);
+    }
+  }
+  leds.flush();
   initGammaTable(RGB_Brightness);
 
   // Load stored EEPROM values from particular address in flash
@@ -279,28 +407,22 @@ void setup() {
 
 // Sets all LEDs red
 void RGB_red() {
-  for (uint8_t led = 0; led < 4; led++) {
-    pwm.setPWM(rgbChannels[led][0], 0, RGB_Brightness); 
-    pwm.setPWM(rgbChannels[led][1], 0, 0);              
-    pwm.setPWM(rgbChannels[led][2], 0, 0);             
+  for (uint8_t led = 0; led < Num_LEDs; led++) {
+    setLED(led, RGB_Brightness, 0, 0);
   }
 }
 
 // Sets all LEDs green
 void RGB_green() {
-  for (uint8_t led = 0; led < 4; led++) {
-    pwm.setPWM(rgbChannels[led][0], 0, 0);
-    pwm.setPWM(rgbChannels[led][1], 0, RGB_Brightness);           
-    pwm.setPWM(rgbChannels[led][2], 0, 0);             
+  for (uint8_t led = 0; led < Num_LEDs; led++) {
+    setLED(led, 0, RGB_Brightness, 0);
   }
 }
 
 // Sets all LEDs blue
 void RGB_blue() {
-  for (uint8_t led = 0; led < 4; led++) {
-    pwm.setPWM(rgbChannels[led][0], 0, 0); 
-    pwm.setPWM(rgbChannels[led][1], 0, 0);             
-    pwm.setPWM(rgbChannels[led][2], 0, RGB_Brightness);              
+  for (uint8_t led = 0; led < Num_LEDs; led++) {
+    setLED(led, 0, 0, RGB_Brightness);
   }
 }
 unsigned long lastWaveUpdate = 0;
@@ -314,7 +436,7 @@ void RGB_yellow_orange() {
 
     lastWaveUpdate = now;
 
-    for (uint8_t led = 0; led < 4; led++) {
+    for (uint8_t led = 0; led < Num_LEDs; led++) {
         float phase = (waveStep * 0.05) + (led * 1.0); // phase offset per LED
         float raw = (sin(phase) * 0.5 + 0.5);          // normalized 0–1 intensity
 
@@ -337,9 +459,7 @@ void RGB_yellow_orange() {
         uint16_t g_pwm = map(g8, 0, 255, 0, RGB_Brightness);
         uint16_t b_pwm = map(b8, 0, 255, 0, RGB_Brightness);
 
-        pwm.setPWM(rgbChannels[led][0], 0, r_pwm);
-        pwm.setPWM(rgbChannels[led][1], 0, g_pwm);
-        pwm.setPWM(rgbChannels[led][2], 0, b_pwm);
+        setLED(led, r_pwm, g_pwm, b_pwm);
     }
 
     waveStep += 0.3;
@@ -350,10 +470,8 @@ void RGB_cyan() {
   uint16_t g_pwm = gammaLUT[255]; // max green
   uint16_t b_pwm = gammaLUT[255]; // max blue
 
-  for (uint8_t led = 0; led < 4; led++) {
-    pwm.setPWM(rgbChannels[led][0], 0, r_pwm); 
-    pwm.setPWM(rgbChannels[led][1], 0, g_pwm);             
-    pwm.setPWM(rgbChannels[led][2], 0, b_pwm);              
+  for (uint8_t led = 0; led < Num_LEDs; led++) {
+    setLED(led, r_pwm, g_pwm, b_pwm);
   }
 }
 
@@ -364,10 +482,8 @@ void RGB_magenta() {
   uint16_t g_pwm = gammaLUT[0];   // green off
 
 
-  for (uint8_t led = 0; led < 4; led++) {
-    pwm.setPWM(rgbChannels[led][0], 0, r_pwm); 
-    pwm.setPWM(rgbChannels[led][1], 0, g_pwm);             
-    pwm.setPWM(rgbChannels[led][2], 0, b_pwm);              
+  for (uint8_t led = 0; led < Num_LEDs; led++) {
+    setLED(led, r_pwm, g_pwm, b_pwm);
   }
 }
 
@@ -382,7 +498,7 @@ void LSU() {
 
   lastLSUUpdate = now;
 
-  for (uint8_t led = 0; led < 4; led++) {
+  for (uint8_t led = 0; led < Num_LEDs; led++) {
     float phase = (lsuStep * 0.02) + (led * 1.0);
     float raw = (sin(phase) * 0.5 + 0.5); // normalized 0–1
     uint16_t r, g, b;
@@ -408,9 +524,7 @@ void LSU() {
     uint16_t b_pwm = gammaLUT[b8];
 
     // Display to RGB
-    pwm.setPWM(rgbChannels[led][0], 0, r_pwm); 
-    pwm.setPWM(rgbChannels[led][1], 0, g_pwm);             
-    pwm.setPWM(rgbChannels[led][2], 0, b_pwm);   
+    setLED(led, r_pwm, g_pwm, b_pwm);
   }
   lsuStep += 0.3;
 }
@@ -427,7 +541,7 @@ void Fire() {
 
     fireInterval = random(30, 150); // random flicker speed
 
-    for (int i = 0; i < 4; i++) { // 4 RGB LEDs
+    for (uint8_t i = 0; i < Num_LEDs; i++) {
         // Base orange (darker)
         uint8_t baseR = 200;
         uint8_t baseG = 60;
@@ -448,9 +562,7 @@ void Fire() {
         int b_flicker = constrain(b_pwm + random(0, 20), 0, 4095);  // B subtle
 
         // Send to PWM
-        pwm.setPWM(rgbChannels[i][0], 0, r_flicker);
-        pwm.setPWM(rgbChannels[i][1], 0, g_flicker);
-        pwm.setPWM(rgbChannels[i][2], 0, b_flicker);
+        setLED(i, r_flicker, g_flicker, b_flicker);
     }
 }
 
@@ -463,7 +575,7 @@ void Rainbow() {
   if (now - lastRainbowStep >= rainbowWait) {
     lastRainbowStep = now;
 
-    for (int i = 0; i < 4; i++) { // 4 RGB LEDs
+    for (uint8_t i = 0; i < Num_LEDs; i++) {
       float phase = (rainbowStep * 0.02) + (i * 1.0); // smaller multiplier = slower, smoother
 
       int r = (sin(phase) * 127 + 128);
@@ -481,9 +593,7 @@ void Rainbow() {
       uint16_t pb = gammaLUT[b8];
 
       // Send to PWM
-      pwm.setPWM(rgbChannels[i][0], 0, pr);
-      pwm.setPWM(rgbChannels[i][1], 0, pg);
-      pwm.setPWM(rgbChannels[i][2], 0, pb);
+      setLED(i, pr, pg, pb);
     }
 
     // Increment rainbowStep by a small float for smooth flow
@@ -533,33 +643,22 @@ void loop() {
     (uint8_t)(hour12 % 10)
   };
 
-  uint8_t digitsToShow[4];
-  if (showingDate) {
-    Display_Date();  // handles timeout
-  } 
-  else if (poisonPrevention) {
-    for (int i = 0; i < 4; i++)
-        digitsToShow[i] = currentDigit[i]; // slot-machine digits
+  // Longer Nixie tube poisoning prevention once at 3AM
+  if (now.hour() == 3 && now.minute() == 0 && lastLongPoisonDay != now.day()) {
+    lastLongPoisonDay = now.day();
+    Start_Poison_Cycle(true);
   }
-  else {
-    for (int i = 0; i < 4; i++)
-      digitsToShow[i] = digits[i];      // normal time
-  }
-
-  if (showingDate) 
-    displayDigit(Date_Digits);
-  else 
-    displayDigit(digitsToShow);
 
-  colonFade(); // Fades colon in and out
-  
   Nixie_Poisoning_Prevention(); // Non-blocking nixie tube poisoning prevention
 
-  longPoison = false;
-  if (now.hour() == 3 && now.minute() == 0) {
-    longPoison = true;
-    Nixie_Poisoning_Prevention(); // Longer Nixie tube poisoning prevention at 3AM
-  }
+  // Exactly one frame per loop goes out to the shift registers
+  Update_Display_Mode();
+  latchFrame(Build_Frame(digits));
+
+  if (!Colon_On())
+    analogWrite(Colon_Digit, 0);
+  else
+    colonFade(); // Fades colon in and out
 
   // Sets RGB preset assigned on IR remote to display 
   if (currentPreset != activeEffect) {
@@ -622,21 +721,22 @@ void loop() {
           RGB_Brightness += 200;
           RGB_Brightness = constrain(RGB_Brightness, 100, 4095);
           EEPROM.put(EEPROM_Brightness_Address, RGB_Brightness);
+          Enter_Setting(map(RGB_Brightness, 100, 4095, 1, Brightness_Levels));
           break;
 
         case Btn_DownArrow:
           RGB_Brightness -= 200;
           RGB_Brightness = constrain(RGB_Brightness, 100, 4095);
           EEPROM.put(EEPROM_Brightness_Address, RGB_Brightness);
+          Enter_Setting(map(RGB_Brightness, 100, 4095, 1, Brightness_Levels));
           break;
 
         case Btn_pnd:
-            Date_Digits[0] = now.day() / 10;
-            Date_Digits[1] = now.day() % 10;
-            Date_Digits[2] = now.month() / 10;
-            Date_Digits[3] = now.month() % 10;
-            dateDisplayStart = millis();
-            showingDate = true;
+            Enter_Date();
+            break;
+
+        case Btn_OK:
+            Toggle_Blank();
             break;
 
         case Btn_asterisk:
@@ -647,10 +747,8 @@ void loop() {
           currentPreset = Preset_Off;
           EEPROM.put(EEPROM_Preset_Address, currentPreset);
 
-          for (uint8_t led = 0; led < 4; led++) {
-            pwm.setPWM(rgbChannels[led][0], 0, 0);
-            pwm.setPWM(rgbChannels[led][1], 0, 0);
-            pwm.setPWM(rgbChannels[led][2], 0, 0);
+          for (uint8_t led = 0; led < Num_LEDs; led++) {
+            setLED(led, 0, 0, 0);
           }
           break;
         case Btn_1:
@@ -692,4 +790,6 @@ void loop() {
     }
     IrReceiver.resume(); // ready for next IR signal
   }
+
+  leds.flush(); // Sends this loop's LED changes to the PCA chips
 }
\ No newline at end of file